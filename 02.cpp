@@ -1,7 +1,12 @@
+#include <algorithm>
+#include <array>
 #include <fstream>
+#include <optional>
 #include <print>
 #include <ranges>
+#include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 
 struct Cubes {
@@ -10,7 +15,7 @@ struct Cubes {
 
 struct Game {
     int id{0};
-    std::vector<Cubes> reveals{};
+    Cubes maximum{};// component-wise maximum over all reveals, the reveals themselves are not stored
 };
 
 auto splitString(std::string_view sv, std::string_view sep) {
@@ -19,6 +24,34 @@ auto splitString(std::string_view sv, std::string_view sep) {
     return partsVec;
 }
 
+// parses a single game line, folding each reveal into the running maxima
+std::optional<Game> parseGame(const std::string &line) {
+    if (!line.starts_with("Game")) return std::nullopt;
+
+    Game g;
+    g.id = std::stoi(line.substr(5));
+
+    auto pv = splitString(line, ":");
+    if (pv.size() != 2) return std::nullopt;
+
+    for (const auto &clist: std::views::split(std::string_view(pv[1]), ';')) {
+        auto colorsVec = splitString(std::string_view(clist.begin(), clist.end()), ",");
+        for (const auto &color: colorsVec) {
+            auto entries = splitString(color, " ");
+            if (entries.size() != 3) continue;
+
+            if (entries[2].starts_with("green"))
+                g.maximum.green = std::max(g.maximum.green, std::stoi(entries[1]));
+            else if (entries[2].starts_with("blue"))
+                g.maximum.blue = std::max(g.maximum.blue, std::stoi(entries[1]));
+            else if (entries[2].starts_with("red"))
+                g.maximum.red = std::max(g.maximum.red, std::stoi(entries[1]));
+        }
+    }
+
+    return g;
+}
+
 auto parseInput(std::string_view fileName) {
     std::ifstream infile(fileName);
     if (!infile)
@@ -28,32 +61,8 @@ auto parseInput(std::string_view fileName) {
     while (!infile.eof()) {
         std::string line;
         std::getline(infile, line);
-        if (!line.starts_with("Game")) continue;
-
-        Game g;
-        g.id = std::stoi(std::string(line.substr(5)));
-
-        auto pv = splitString(line, ":");
-        if (pv.size() != 2) continue;
-
-        auto cubesVec = splitString(pv[1], ";");
-        for (const auto &clist: cubesVec) {
-            Cubes cubes;
-            auto colorsVec = splitString(clist, ",");
-            for (const auto &color: colorsVec) {
-                auto entries = splitString(color, " ");
-                if (entries.size() != 3) continue;
-
-                if (entries[2].starts_with("green"))
-                    cubes.green = std::stoi(entries[1]);
-                else if (entries[2].starts_with("blue"))
-                    cubes.blue = std::stoi(entries[1]);
-                else if (entries[2].starts_with("red"))
-                    cubes.red = std::stoi(entries[1]);
-            }
-            g.reveals.push_back(cubes);
-        }
-        games.push_back(std::move(g));
+        if (auto g = parseGame(line))
+            games.push_back(*g);
     }
 
     return games;
@@ -63,40 +72,145 @@ bool isImpossible(const Cubes &cubes, const Cubes &availableCubes) {
     return (cubes.red > availableCubes.red) || (cubes.blue > availableCubes.blue) || (cubes.green > availableCubes.green);
 }
 
-auto solvePart1(const std::vector<Game> &games) {
-    Cubes availableCubes{12, 13, 14};
+long power(const Cubes &cubes) {
+    return static_cast<long>(cubes.red) * cubes.green * cubes.blue;
+}
 
-    int sumIDs{0};
-    for (const auto &g: games) {
-        int gamePossible{true};
-        for (const auto &cubes: g.reveals) {
-            if (isImpossible(cubes, availableCubes)) {
-                gamePossible = false;
-                break;
-            }
-        }
-        if (gamePossible)
-            sumIDs += g.id;
+// fused mode, an alternative to parseInput and solvePart1/2 for logs that should not be kept in memory:
+// streams the game log and emits both parts' contributions per game, keeping nothing but the current line
+auto solveStreaming(std::string_view fileName, const Cubes &availableCubes = {12, 13, 14}) {
+    std::ifstream infile(fileName);
+    if (!infile)
+        throw std::runtime_error("Could not open file " + std::string(fileName));
+
+    long sumIDs{0}, sumPower{0};
+    while (!infile.eof()) {
+        std::string line;
+        std::getline(infile, line);
+        auto g = parseGame(line);
+        if (!g) continue;
+
+        if (!isImpossible(g->maximum, availableCubes))
+            sumIDs += g->id;
+        sumPower += power(g->maximum);
     }
 
-    return sumIDs;
+    return std::pair{sumIDs, sumPower};
 }
 
-auto solvePart2(const std::vector<Game> &games) {
-    int sumPower{0};
+// per-game maxima in structure-of-arrays layout, for running many bag queries against the same log
+struct GameMaxima {
+    std::vector<int> ids, red, green, blue;
+};
+
+auto computeMaxima(const std::vector<Game> &games) {
+    GameMaxima maxima;
     for (const auto &g: games) {
-        Cubes minimumCubes;
-        for (const auto &cubes: g.reveals) {
-            if (cubes.red > minimumCubes.red)
-                minimumCubes.red = cubes.red;
-            if (cubes.green > minimumCubes.green)
-                minimumCubes.green = cubes.green;
-            if (cubes.blue > minimumCubes.blue)
-                minimumCubes.blue = cubes.blue;
+        maxima.ids.push_back(g.id);
+        maxima.red.push_back(g.maximum.red);
+        maxima.green.push_back(g.maximum.green);
+        maxima.blue.push_back(g.maximum.blue);
+    }
+    return maxima;
+}
+
+// 3D dominance index: table[r][g][b] holds the sum of IDs of all games whose maxima are <= the (compressed) bag r/g/b.
+// Each query is then three binary searches plus one lookup. If the table would get too large, fall back to a linear scan.
+class BagIndex {
+public:
+    explicit BagIndex(GameMaxima maxima) : maxima_(std::move(maxima)) {
+        axes_ = {maxima_.red, maxima_.green, maxima_.blue};
+        std::size_t tableSize{1};
+        for (auto &axis: axes_) {
+            std::ranges::sort(axis);
+            auto [first, last] = std::ranges::unique(axis);
+            axis.erase(first, last);
+            // multiplied one axis at a time against the limit, so the product cannot wrap around
+            if (axis.empty() || axis.size() > maxTableSize / tableSize)
+                return;
+            tableSize *= axis.size();
         }
-        sumPower += minimumCubes.red * minimumCubes.green * minimumCubes.blue;
+
+        table_.assign(tableSize, 0);
+        for (std::size_t i{0}; i < maxima_.ids.size(); ++i)
+            table_[index(axisIndex(0, maxima_.red[i]), axisIndex(1, maxima_.green[i]), axisIndex(2, maxima_.blue[i]))] += maxima_.ids[i];
+
+        // prefix sums along each axis turn the counts into dominance sums
+        for (std::size_t r{1}; r < axes_[0].size(); ++r)
+            for (std::size_t g{0}; g < axes_[1].size(); ++g)
+                for (std::size_t b{0}; b < axes_[2].size(); ++b)
+                    table_[index(r, g, b)] += table_[index(r - 1, g, b)];
+        for (std::size_t r{0}; r < axes_[0].size(); ++r)
+            for (std::size_t g{1}; g < axes_[1].size(); ++g)
+                for (std::size_t b{0}; b < axes_[2].size(); ++b)
+                    table_[index(r, g, b)] += table_[index(r, g - 1, b)];
+        for (std::size_t r{0}; r < axes_[0].size(); ++r)
+            for (std::size_t g{0}; g < axes_[1].size(); ++g)
+                for (std::size_t b{1}; b < axes_[2].size(); ++b)
+                    table_[index(r, g, b)] += table_[index(r, g, b - 1)];
+    }
+
+    [[nodiscard]] long sumPossibleIDs(const Cubes &bag) const {
+        if (table_.empty())
+            return scanPossibleIDs(bag);
+
+        auto r = upperIndex(0, bag.red), g = upperIndex(1, bag.green), b = upperIndex(2, bag.blue);
+        if (r == 0 || g == 0 || b == 0)
+            return 0;
+        return table_[index(r - 1, g - 1, b - 1)];
+    }
+
+    [[nodiscard]] std::vector<long> sumPossibleIDs(const std::vector<Cubes> &bags) const {
+        std::vector<long> sums;
+        sums.reserve(bags.size());
+        for (const auto &bag: bags)
+            sums.push_back(sumPossibleIDs(bag));
+        return sums;
+    }
+
+private:
+    static constexpr std::size_t maxTableSize{1uz << 24};
+
+    [[nodiscard]] std::size_t index(std::size_t r, std::size_t g, std::size_t b) const {
+        return (r * axes_[1].size() + g) * axes_[2].size() + b;
+    }
+
+    [[nodiscard]] std::size_t axisIndex(std::size_t axis, int value) const {
+        return std::ranges::lower_bound(axes_[axis], value) - axes_[axis].begin();
     }
 
+    // number of axis entries <= value
+    [[nodiscard]] std::size_t upperIndex(std::size_t axis, int value) const {
+        return std::ranges::upper_bound(axes_[axis], value) - axes_[axis].begin();
+    }
+
+    // branch-free loop over the SoA arrays, vectorizes nicely
+    [[nodiscard]] long scanPossibleIDs(const Cubes &bag) const {
+        long sumIDs{0};
+        for (std::size_t i{0}; i < maxima_.ids.size(); ++i) {
+            bool possible = (maxima_.red[i] <= bag.red) & (maxima_.green[i] <= bag.green) & (maxima_.blue[i] <= bag.blue);
+            sumIDs += possible ? maxima_.ids[i] : 0;
+        }
+        return sumIDs;
+    }
+
+    GameMaxima maxima_;// kept for the scan fallback
+    std::array<std::vector<int>, 3> axes_;
+    std::vector<long> table_;
+};
+
+auto solvePart1(const GameMaxima &maxima) {
+    Cubes availableCubes{12, 13, 14};
+
+    BagIndex index(maxima);
+    return index.sumPossibleIDs(availableCubes);
+}
+
+auto solvePart2(const GameMaxima &maxima) {
+    long sumPower{0};
+    for (std::size_t i{0}; i < maxima.ids.size(); ++i)
+        sumPower += power(Cubes{maxima.red[i], maxima.green[i], maxima.blue[i]});
+
     return sumPower;
 }
 
@@ -104,9 +218,9 @@ int main() {
     std::println("AoC 2023: 02");
 
     try {
-        auto games = parseInput("../inputs/02.txt");
-        std::println("Part 1: {}", solvePart1(games));
-        std::println("Part 2: {}", solvePart2(games));
+        auto maxima = computeMaxima(parseInput("../inputs/02.txt"));
+        std::println("Part 1: {}", solvePart1(maxima));
+        std::println("Part 2: {}", solvePart2(maxima));
     } catch (std::exception &e) {
         std::println("Exception: {}", e.what());
     }
@@ -1,9 +1,15 @@
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <cctype>
+#include <cstdint>
 #include <fstream>
+#include <limits>
+#include <numeric>
 #include <print>
 #include <string>
 #include <string_view>
-#include <unordered_set>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -24,97 +30,302 @@ auto parseInput(std::string_view filename) {
     return schematic;
 }
 
-auto solvePart1(const std::vector<std::string> &schematic) {
-    int sumNumbers{0};
-
-    for (std::size_t i{0}; i < schematic.size(); ++i) {
-        for (std::size_t l{0}; l < schematic[i].size(); ++l) {
-            if (!std::isdigit(schematic[i][l])) continue;
-            std::size_t len{0};
-            int number = std::stoi(schematic[i].substr(l), &len);
-
-            // check if number has adjacent symbol
-            bool hasSymbol{false};
-            for (std::size_t itest{(i == 0) ? 0uz : i - 1}; itest <= std::min(i + 1uz, schematic.size() - 1); ++itest) {
-                for (std::size_t ltest{(l == 0) ? 0uz : l - 1}; ltest <= std::min(l + len, schematic[i].size() - 1); ++ltest) {
-                    auto c = schematic[itest][ltest];
-                    if (c != '.' && !std::isdigit(c)) {
-                        hasSymbol = true;
-                        break;
-                    }
-                }
-                if (hasSymbol) break;
-            }
-            if (hasSymbol)
-                sumNumbers += number;
+bool isDigit(char c) { return std::isdigit(static_cast<unsigned char>(c)); }
+bool isSymbol(char c) { return c != '.' && !isDigit(c); }
+
+// one band per core, but never more bands than rows
+std::size_t getNoBands(std::size_t rows) {
+    return std::clamp<std::size_t>(std::thread::hardware_concurrency(), 1, std::max(rows, 1uz));
+}
+
+// splits the rows into one horizontal band per core and runs func(band, rowBegin, rowEnd) for each band on its own thread.
+// Bands only write their own rows; reading one halo row above and below is fine once the previous phase has finished.
+template<typename Func>
+void forEachBand(std::size_t rows, Func func) {
+    auto noBands = getNoBands(rows);
+    std::vector<std::jthread> threads;
+    threads.reserve(noBands);
+    for (std::size_t band{0}; band < noBands; ++band)
+        threads.emplace_back(func, band, rows * band / noBands, rows * (band + 1) / noBands);
+}
+
+// numbers are attributed to the band holding their row, gears to the band holding their '*', so nothing is counted twice
+template<typename Func>
+long sumOverBands(std::size_t rows, Func sumRows) {
+    std::vector<long> partialSums(getNoBands(rows), 0);
+    forEachBand(rows, [&](std::size_t band, std::size_t rowBegin, std::size_t rowEnd) {
+        partialSums[band] = sumRows(rowBegin, rowEnd);
+    });
+    return std::accumulate(partialSums.begin(), partialSums.end(), 0l);
+}
+
+// label grid: every digit cell stores the ID of its number, which is the flat index of the number's first digit
+struct NumberLabels {
+    static constexpr std::size_t none{std::numeric_limits<std::size_t>::max()};
 
-            l += len;
+    std::size_t rows{0}, cols{0};
+    std::vector<std::size_t> ids;// number ID per cell, none for non-digit cells
+    std::vector<long> values;    // number value, stored at the ID (i.e. first digit) cell
+
+    [[nodiscard]] std::size_t id(std::size_t i, std::size_t l) const { return ids[i * cols + l]; }
+};
+
+// labels the columns [lBegin, lEnd) of row i, the range must not cut through a number
+void labelRow(const std::vector<std::string> &schematic, NumberLabels &labels, std::size_t i, std::size_t lBegin = 0, std::size_t lEnd = NumberLabels::none) {
+    const auto &row = schematic[i];
+    lEnd = std::min(lEnd, row.size());
+    for (std::size_t l{lBegin}; l < lEnd;) {
+        if (!isDigit(row[l])) {
+            ++l;
+            continue;
+        }
+
+        auto id = i * labels.cols + l;
+        long number{0};
+        for (; l < lEnd && isDigit(row[l]); ++l) {
+            number = 10 * number + (row[l] - '0');
+            labels.ids[i * labels.cols + l] = id;
         }
+        labels.values[id] = number;
     }
+}
 
-    return sumNumbers;
+auto labelNumbers(const std::vector<std::string> &schematic) {
+    NumberLabels labels;
+    labels.rows = schematic.size();
+    for (const auto &row: schematic)
+        labels.cols = std::max(labels.cols, row.size());
+    labels.ids.assign(labels.rows * labels.cols, NumberLabels::none);
+    labels.values.assign(labels.rows * labels.cols, 0);
+
+    forEachBand(labels.rows, [&](std::size_t, std::size_t rowBegin, std::size_t rowEnd) {
+        for (std::size_t i{rowBegin}; i < rowEnd; ++i)
+            labelRow(schematic, labels, i);
+    });
+
+    return labels;
 }
 
-template<>
-struct std::hash<std::pair<std::size_t, std::size_t>> {
-    std::size_t operator()(const std::pair<std::size_t, std::size_t> &c) const noexcept {
-        return c.first * 31 + c.second;
+// distinct numbers touching cell (i, l), there can be at most two per row
+struct AdjacentNumbers {
+    std::array<std::size_t, 6> ids{};
+    std::size_t count{0};
+};
+
+auto getAdjacentNumbers(const NumberLabels &labels, std::size_t i, std::size_t l) {
+    AdjacentNumbers adjacent;
+    for (std::size_t itest{(i == 0) ? 0uz : i - 1}; itest <= std::min(i + 1uz, labels.rows - 1); ++itest) {
+        auto previous{NumberLabels::none};
+        for (std::size_t ltest{(l == 0) ? 0uz : l - 1}; ltest <= std::min(l + 1uz, labels.cols - 1); ++ltest) {
+            auto id = labels.id(itest, ltest);
+            if (id != NumberLabels::none && id != previous)// cells of one number are contiguous within a row
+                adjacent.ids[adjacent.count++] = id;
+            previous = id;
+        }
     }
+    return adjacent;
+}
+
+// bit-parallel row masks: bit l of word l / 64 in row i is set if column l holds a symbol (digit)
+struct RowMasks {
+    std::size_t rows{0}, words{0};
+    std::vector<std::uint64_t> symbols, digits;
+
+    [[nodiscard]] std::uint64_t symbol(std::size_t i, std::size_t w) const { return symbols[i * words + w]; }
+    [[nodiscard]] std::uint64_t digit(std::size_t i, std::size_t w) const { return digits[i * words + w]; }
 };
 
-auto getCandidates(const std::vector<std::string> &schematic, std::size_t i, std::size_t l) {
-    std::unordered_set<std::pair<std::size_t, std::size_t>> candidates;
-    std::vector<std::size_t> rows{i};
-    if (i > 0) rows.push_back(i - 1);
-    if (i + 1 < schematic.size()) rows.push_back(i + 1);
-
-    for (const auto row: rows) {
-        if (std::isdigit(schematic[row][l]))
-            candidates.emplace(row, l);
-        else {
-            if (l > 0 && std::isdigit(schematic[row][l - 1]))
-                candidates.emplace(row, l - 1);
-            if (l + 1 < schematic[row].size() && std::isdigit(schematic[row][l + 1]))
-                candidates.emplace(row, l + 1);
+void maskRow(const std::vector<std::string> &schematic, RowMasks &masks, std::size_t i) {
+    const auto &row = schematic[i];
+    for (std::size_t l{0}; l < row.size(); ++l) {
+        auto bit = std::uint64_t{1} << (l % 64);
+        if (isSymbol(row[l]))
+            masks.symbols[i * masks.words + l / 64] |= bit;
+        else if (isDigit(row[l]))
+            masks.digits[i * masks.words + l / 64] |= bit;
+    }
+}
+
+auto buildRowMasks(const std::vector<std::string> &schematic, const NumberLabels &labels) {
+    RowMasks masks;
+    masks.rows = labels.rows;
+    masks.words = (labels.cols + 63) / 64;
+    masks.symbols.assign(masks.rows * masks.words, 0);
+    masks.digits.assign(masks.rows * masks.words, 0);
+
+    forEachBand(masks.rows, [&](std::size_t, std::size_t rowBegin, std::size_t rowEnd) {
+        for (std::size_t i{rowBegin}; i < rowEnd; ++i)
+            maskRow(schematic, masks, i);
+    });
+
+    return masks;
+}
+
+// symbol masks of the three neighbouring rows are ORed and dilated by one column, then ANDed against the digits.
+// Hits are spread down to the first digit of each run, whose cell ID carries the number value.
+long sumPartNumbersInRow(const RowMasks &masks, const NumberLabels &labels, std::size_t i, std::vector<std::uint64_t> &neighborhood, std::vector<std::uint64_t> &hits) {
+    const auto words = masks.words;
+    for (std::size_t w{0}; w < words; ++w) {
+        neighborhood[w] = masks.symbol(i, w);
+        if (i > 0) neighborhood[w] |= masks.symbol(i - 1, w);
+        if (i + 1 < masks.rows) neighborhood[w] |= masks.symbol(i + 1, w);
+    }
+
+    for (std::size_t w{0}; w < words; ++w) {
+        auto s = neighborhood[w];
+        auto lower = (w > 0) ? neighborhood[w - 1] : 0;
+        auto higher = (w + 1 < words) ? neighborhood[w + 1] : 0;
+        hits[w] = (s | (s << 1) | (lower >> 63) | (s >> 1) | (higher << 63)) & masks.digit(i, w);
+    }
+
+    // one iteration per digit, so typically two rounds
+    bool changed{true};
+    while (changed) {
+        changed = false;
+        for (std::size_t w{0}; w < words; ++w) {
+            auto higher = (w + 1 < words) ? hits[w + 1] : 0;
+            auto spread = hits[w] | (((hits[w] >> 1) | (higher << 63)) & masks.digit(i, w));
+            changed |= (spread != hits[w]);
+            hits[w] = spread;
+        }
+    }
+
+    long sumNumbers{0};
+    for (std::size_t w{0}; w < words; ++w) {
+        auto lower = (w > 0) ? masks.digit(i, w - 1) : 0;
+        auto starts = hits[w] & ~((masks.digit(i, w) << 1) | (lower >> 63));
+        while (starts) {
+            auto l = w * 64 + std::countr_zero(starts);
+            sumNumbers += labels.values[i * labels.cols + l];
+            starts &= starts - 1;
         }
     }
+    return sumNumbers;
+}
 
-    return candidates;
+auto solvePart1(const RowMasks &masks, const NumberLabels &labels) {
+    return sumOverBands(masks.rows, [&](std::size_t rowBegin, std::size_t rowEnd) {
+        long sumNumbers{0};
+        std::vector<std::uint64_t> neighborhood(masks.words), hits(masks.words);
+        for (std::size_t i{rowBegin}; i < rowEnd; ++i)
+            sumNumbers += sumPartNumbersInRow(masks, labels, i, neighborhood, hits);
+        return sumNumbers;
+    });
 }
 
-auto getNumber(const std::vector<std::string> &schematic, std::size_t row, std::size_t col) {
-    while (col > 0 && std::isdigit(schematic[row][col - 1]))
-        --col;
-    return std::stoi(schematic[row].substr(col));
+auto solvePart2(const std::vector<std::string> &schematic, const NumberLabels &labels) {
+    return sumOverBands(schematic.size(), [&](std::size_t rowBegin, std::size_t rowEnd) {
+        long sumGearRatios{0};
+        for (std::size_t i{rowBegin}; i < rowEnd; ++i) {
+            for (std::size_t l{0}; l < schematic[i].size(); ++l) {
+                if (schematic[i][l] != '*') continue;
+
+                auto adjacent = getAdjacentNumbers(labels, i, l);
+                if (adjacent.count != 2) continue;
+                sumGearRatios += labels.values[adjacent.ids[0]] * labels.values[adjacent.ids[1]];
+            }
+        }
+        return sumGearRatios;
+    });
 }
 
-auto solvePart2(const std::vector<std::string> &schematic) {
-    int sumGearRatios{0};
+// keeps both totals up to date under single-cell edits: only the numbers and gears around the edited cell are recomputed,
+// so an edit costs O(length of the touched numbers) instead of a full rescan
+class IncrementalSchematic {
+public:
+    explicit IncrementalSchematic(std::vector<std::string> schematic) : schematic_(std::move(schematic)) {
+        labels_ = labelNumbers(schematic_);
+        for (auto &row: schematic_)
+            row.resize(labels_.cols, '.');// allow edits anywhere in the bounding box
+        sumPartNumbers_ = solvePart1(buildRowMasks(schematic_, labels_), labels_);
+        sumGearRatios_ = solvePart2(schematic_, labels_);
+    }
+
+    void set(std::size_t i, std::size_t l, char c) {
+        if (i >= labels_.rows || l >= labels_.cols)
+            throw std::runtime_error("Edit outside of schematic");
+        if (schematic_[i][l] == c) return;
+
+        // numbers in row i that can change lie within [lo, hi], i.e. the ones touching the columns l-1 to l+1
+        auto lo = (l == 0) ? l : l - 1;
+        auto hi = std::min(l + 1, labels_.cols - 1);
+        while (lo > 0 && isDigit(schematic_[i][lo]) && isDigit(schematic_[i][lo - 1])) --lo;
+        while (hi + 1 < labels_.cols && isDigit(schematic_[i][hi]) && isDigit(schematic_[i][hi + 1])) ++hi;
 
-    for (std::size_t i{0}; i < schematic.size(); ++i) {
-        for (std::size_t l{0}; l < schematic[i].size(); ++l) {
-            if (schematic[i][l] != '*') continue;
-            auto candidates = getCandidates(schematic, i, l);
-            if (candidates.size() != 2) continue;
+        auto [partsBefore, gearsBefore] = regionTotals(i, l, lo, hi);
 
-            int product{1};
-            for (const auto &[row, col]: candidates) {
-                product *= getNumber(schematic, row, col);
+        schematic_[i][l] = c;
+        std::fill(labels_.ids.begin() + i * labels_.cols + lo, labels_.ids.begin() + i * labels_.cols + hi + 1, NumberLabels::none);
+        labelRow(schematic_, labels_, i, lo, hi + 1);
+
+        auto [partsAfter, gearsAfter] = regionTotals(i, l, lo, hi);
+        sumPartNumbers_ += partsAfter - partsBefore;
+        sumGearRatios_ += gearsAfter - gearsBefore;
+    }
+
+    [[nodiscard]] long sumPartNumbers() const { return sumPartNumbers_; }
+    [[nodiscard]] long sumGearRatios() const { return sumGearRatios_; }
+
+private:
+    [[nodiscard]] bool isPartNumber(std::size_t id) const {
+        auto i = id / labels_.cols, lStart = id % labels_.cols, lEnd{lStart};
+        while (lEnd + 1 < labels_.cols && labels_.id(i, lEnd + 1) == id) ++lEnd;
+
+        for (std::size_t itest{(i == 0) ? 0uz : i - 1}; itest <= std::min(i + 1uz, labels_.rows - 1); ++itest) {
+            for (std::size_t ltest{(lStart == 0) ? 0uz : lStart - 1}; ltest <= std::min(lEnd + 1uz, labels_.cols - 1); ++ltest) {
+                if (isSymbol(schematic_[itest][ltest]))
+                    return true;
             }
-            sumGearRatios += product;
         }
+        return false;
     }
 
-    return sumGearRatios;
-}
+    // contributions of everything an edit at (i, l) can influence: the numbers in row i within [lo, hi],
+    // the numbers next to (i, l) in the rows above and below, and all gears next to any of those
+    [[nodiscard]] std::pair<long, long> regionTotals(std::size_t i, std::size_t l, std::size_t lo, std::size_t hi) const {
+        auto rowBegin = (i == 0) ? 0uz : i - 1, rowEnd = std::min(i + 1uz, labels_.rows - 1);
+
+        long sumNumbers{0};
+        for (std::size_t itest{rowBegin}; itest <= rowEnd; ++itest) {
+            auto lBegin = (itest == i) ? lo : ((l == 0) ? 0uz : l - 1);
+            auto lEnd = (itest == i) ? hi : std::min(l + 1uz, labels_.cols - 1);
+            auto previous{NumberLabels::none};
+            for (std::size_t ltest{lBegin}; ltest <= lEnd; ++ltest) {
+                auto id = labels_.id(itest, ltest);
+                if (id != NumberLabels::none && id != previous && isPartNumber(id))
+                    sumNumbers += labels_.values[id];
+                previous = id;
+            }
+        }
+
+        long sumGearRatios{0};
+        for (std::size_t itest{rowBegin}; itest <= rowEnd; ++itest) {
+            for (std::size_t ltest{(lo == 0) ? 0uz : lo - 1}; ltest <= std::min(hi + 1uz, labels_.cols - 1); ++ltest) {
+                if (schematic_[itest][ltest] != '*') continue;
+
+                auto adjacent = getAdjacentNumbers(labels_, itest, ltest);
+                if (adjacent.count == 2)
+                    sumGearRatios += labels_.values[adjacent.ids[0]] * labels_.values[adjacent.ids[1]];
+            }
+        }
+
+        return {sumNumbers, sumGearRatios};
+    }
+
+    std::vector<std::string> schematic_;
+    NumberLabels labels_;
+    long sumPartNumbers_{0}, sumGearRatios_{0};
+};
 
 int main() {
     std::println("AoC 2023: 03");
 
     try {
         auto schematic = parseInput("../inputs/03.txt");
-        std::println("Part 1: {}", solvePart1(schematic));
-        std::println("Part 2: {}", solvePart2(schematic));
+        auto labels = labelNumbers(schematic);
+        auto masks = buildRowMasks(schematic, labels);
+        std::println("Part 1: {}", solvePart1(masks, labels));
+        std::println("Part 2: {}", solvePart2(schematic, labels));
     } catch (std::exception &e) {
         std::println("Exception: {}", e.what());
     }
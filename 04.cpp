@@ -1,107 +1,215 @@
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <exception>
 #include <format>
 #include <fstream>
+#include <iterator>
 #include <print>
-#include <ranges>
 #include <string>
 #include <string_view>
-#include <unordered_set>
+#include <thread>
+#include <utility>
 #include <vector>
 
-struct ScratchCard {
-    std::unordered_set<int> winningNumbers;
-    std::vector<int> numbers;
-    int count{1};
+// all cards as fixed-width bitsets in one contiguous array: bit n of a card's set is set if the card holds number n
+struct ScratchCards {
+    std::size_t words{2};// 128 bits per set, widened up to maxBitsetNumber when the numbers require it
+    std::vector<std::uint64_t> winningNumbers, numbers;
+
+    [[nodiscard]] std::size_t size() const { return winningNumbers.size() / words; }
+
+    [[nodiscard]] int getNumberOfMatchingNumbers(std::size_t card) const {
+        const auto *winning = winningNumbers.data() + card * words;
+        const auto *have = numbers.data() + card * words;
+        int noMatching{0};
+        for (std::size_t w{0}; w < words; ++w)
+            noMatching += std::popcount(winning[w] & have[w]);
+        return noMatching;
+    }
 };
 
-auto splitString(std::string_view sv, std::string_view sep) {
-    auto parts = std::views::split(sv, sep);
-    auto partsVec = std::ranges::to<std::vector<std::string>>(parts);
-    return partsVec;
+auto parseNumbers(std::string_view sv, int &maxNumber) {
+    std::vector<int> numbers;
+    while (!sv.empty()) {
+        if (std::isspace(static_cast<unsigned char>(sv.front()))) {// also skips the '\r' of CRLF line endings
+            sv.remove_prefix(1);
+            continue;
+        }
+        int number{0};
+        auto [ptr, ec] = std::from_chars(sv.data(), sv.data() + sv.size(), number);
+        if (ec != std::errc() || number < 0)
+            throw std::runtime_error("Invalid number in " + std::string(sv));
+        sv.remove_prefix(ptr - sv.data());
+        numbers.push_back(number);
+        maxNumber = std::max(maxNumber, number);
+    }
+    return numbers;
 }
 
-auto parseInput(std::string_view filename) {
-    std::ifstream infile(filename);
-    if (!infile)
-        throw std::runtime_error("Could not open file " + std::string(filename));
+struct Card {
+    std::vector<int> winningNumbers, numbers;
+};
 
-    std::vector<ScratchCard> cards;
-    while (!infile.eof()) {
-        std::string line;
-        std::getline(infile, line);
+auto parseCards(std::string_view text, int &maxNumber) {
+    std::vector<Card> cards;
+    while (!text.empty()) {
+        auto eol = text.find('\n');
+        auto line = text.substr(0, eol);
+        text.remove_prefix((eol == std::string_view::npos) ? text.size() : eol + 1);
         if (line.empty()) continue;
 
-        ScratchCard card;
-        std::string_view lv{line};
-        lv.remove_prefix(lv.find(": ") + 1);
-        auto parts = splitString(lv, " | ");
-        if (parts.size() != 2) continue;
-        auto winNums = splitString(parts[0], " ");
-        for (const auto &num: winNums) {
-            if (num.empty()) continue;
-            card.winningNumbers.insert(std::stoi(num));
-        }
+        line.remove_prefix(line.find(": ") + 1);
+        auto sep = line.find(" | ");
+        if (sep == std::string_view::npos) continue;
 
-        auto numbers = splitString(parts[1], " ");
-        for (const auto &num: numbers) {
-            if (num.empty()) continue;
-            card.numbers.push_back(std::stoi(num));
-        }
-
-        cards.push_back(std::move(card));
+        auto winNums = parseNumbers(line.substr(0, sep), maxNumber);
+        cards.push_back(Card{std::move(winNums), parseNumbers(line.substr(sep + 3), maxNumber)});
     }
-
     return cards;
 }
 
-auto solvePart1(const std::vector<ScratchCard> &cards) {
-    int points{0};
-    for (const auto &card: cards) {
-        int score{0};
-        for (const auto &num: card.numbers) {
-            if (card.winningNumbers.contains(num)) {
-                if (score != 0) score *= 2;
-                else
-                    score = 1;
-            }
-        }
-        points += score;
+// numbers up to this bound go into bitsets of at most 16 words, larger ones would blow up every card of the chunk
+constexpr int maxBitsetNumber{16 * 64 - 1};
+
+ScratchCards packCards(const std::vector<Card> &parsedCards, int maxNumber) {
+    ScratchCards cards;
+    cards.words = std::max(cards.words, static_cast<std::size_t>(maxNumber) / 64 + 1);
+    cards.winningNumbers.assign(parsedCards.size() * cards.words, 0);
+    cards.numbers.assign(parsedCards.size() * cards.words, 0);
+    for (std::size_t i{0}; i < parsedCards.size(); ++i) {
+        for (auto num: parsedCards[i].winningNumbers)
+            cards.winningNumbers[i * cards.words + num / 64] |= std::uint64_t{1} << (num % 64);
+        for (auto num: parsedCards[i].numbers)
+            cards.numbers[i * cards.words + num / 64] |= std::uint64_t{1} << (num % 64);
     }
 
-    return points;
+    return cards;
 }
 
-auto getNumberOfMatchingNumbers(const ScratchCard &card) {
+// fallback for large numbers: both lists as sorted sets, duplicates count once as in the bitsets
+int getNumberOfMatchingNumbers(Card card) {
+    for (auto *list: {&card.winningNumbers, &card.numbers}) {
+        std::ranges::sort(*list);
+        auto [first, last] = std::ranges::unique(*list);
+        list->erase(first, last);
+    }
     int noMatching{0};
-    for (const auto &num: card.numbers) {
-        if (card.winningNumbers.contains(num))
+    for (std::size_t w{0}, n{0}; w < card.winningNumbers.size() && n < card.numbers.size();) {
+        if (card.winningNumbers[w] < card.numbers[n])
+            ++w;
+        else if (card.numbers[n] < card.winningNumbers[w])
+            ++n;
+        else {
             ++noMatching;
+            ++w;
+            ++n;
+        }
     }
     return noMatching;
 }
 
+auto getNumbersOfMatchingNumbers(std::string_view text) {
+    int maxNumber{0};
+    auto parsedCards = parseCards(text, maxNumber);
+    std::vector<int> matches(parsedCards.size());
+    if (maxNumber > maxBitsetNumber) {
+        for (std::size_t i{0}; i < parsedCards.size(); ++i)
+            matches[i] = getNumberOfMatchingNumbers(std::move(parsedCards[i]));
+        return matches;
+    }
 
-auto solvePart2(std::vector<ScratchCard> &cards) {
-    for (std::size_t i{0}; i < cards.size(); ++i) {
-        auto matches = getNumberOfMatchingNumbers(cards[i]);
-        for (std::size_t m{1}; m <= matches; ++m) {
-            if (i + m < cards.size())
-                cards[i + m].count += cards[i].count;
-        }
+    auto cards = packCards(parsedCards, maxNumber);
+    for (std::size_t i{0}; i < cards.size(); ++i)
+        matches[i] = cards.getNumberOfMatchingNumbers(i);
+    return matches;
+}
+
+// parse-and-match pipeline: the input is cut into one chunk of whole lines per core, each chunk is parsed and
+// matched on its own thread, and the per-card match counts are concatenated in input order
+auto parseInput(std::string_view filename) {
+    std::ifstream infile(filename);
+    if (!infile)
+        throw std::runtime_error("Could not open file " + std::string(filename));
+    std::string text{std::istreambuf_iterator<char>(infile), std::istreambuf_iterator<char>()};
+
+    auto noChunks = std::max(std::thread::hardware_concurrency(), 1u);
+    std::vector<std::string_view> chunks;
+    std::string_view rest{text};
+    for (unsigned c{noChunks}; c > 0 && !rest.empty(); --c) {
+        auto eol = (c == 1) ? std::string_view::npos : rest.find('\n', rest.size() / c);
+        auto length = (eol == std::string_view::npos) ? rest.size() : eol + 1;
+        chunks.push_back(rest.substr(0, length));
+        rest.remove_prefix(length);
+    }
+
+    // an exception escaping a thread would terminate, so each worker hands it back to be rethrown after the join
+    std::vector<std::vector<int>> chunkMatches(chunks.size());
+    std::vector<std::exception_ptr> chunkErrors(chunks.size());
+    {
+        std::vector<std::jthread> threads;
+        for (std::size_t c{0}; c < chunks.size(); ++c)
+            threads.emplace_back([&, c] {
+                try {
+                    chunkMatches[c] = getNumbersOfMatchingNumbers(chunks[c]);
+                } catch (...) {
+                    chunkErrors[c] = std::current_exception();
+                }
+            });
+    }
+    for (const auto &error: chunkErrors)
+        if (error)
+            std::rethrow_exception(error);
+
+    std::vector<int> matches;
+    for (const auto &m: chunkMatches)
+        matches.insert(matches.end(), m.begin(), m.end());
+    return matches;
+}
+
+auto solvePart1(const std::vector<int> &matches) {
+    std::uint64_t points{0};
+    for (auto noMatching: matches) {
+        if (noMatching > 64)
+            throw std::runtime_error("Card score exceeds 64 bits");
+        if (noMatching > 0)
+            points += std::uint64_t{1} << (noMatching - 1);
+    }
+
+    return points;
+}
+
+// card cascade over a running difference array: the copies of card i are added from card i + 1 on and removed again
+// after card i + matches, so every card is touched once. Unsigned wrap-around keeps the differences exact.
+std::uint64_t cascadeCards(const std::vector<int> &matches) {
+    std::vector<std::uint64_t> delta(matches.size() + 1, 0);
+    std::uint64_t copies{0}, noCards{0};
+    for (std::size_t i{0}; i < matches.size(); ++i) {
+        copies += delta[i];
+        auto count = 1 + copies;
+        noCards += count;
+
+        auto last = std::min(i + static_cast<std::size_t>(matches[i]), matches.size() - 1);
+        delta[i + 1] += count;
+        delta[last + 1] -= count;
     }
 
-    int noCards{0};
-    for (const auto &card: cards)
-        noCards += card.count;
     return noCards;
 }
 
+auto solvePart2(const std::vector<int> &matches) {
+    return cascadeCards(matches);
+}
+
 int main() {
     std::println("AoC 2023: 04");
 
     try {
-        auto cards = parseInput("../inputs/04.txt");
-        std::println("Part 1: {}", solvePart1(cards));
-        std::println("Part 2: {}", solvePart2(cards));
+        auto matches = parseInput("../inputs/04.txt");
+        std::println("Part 1: {}", solvePart1(matches));
+        std::println("Part 2: {}", solvePart2(matches));
     } catch (std::exception &e) {
         std::println("Exception: {}", e.what());
     }
@@ -1,4 +1,6 @@
+#include <algorithm>
 #include <array>
+#include <bit>
 #include <charconv>
 #include <format>
 #include <fstream>
@@ -10,6 +12,137 @@
 #include <string_view>
 #include <vector>
 
+// half-open interval [begin, end)
+struct Interval {
+    long begin, end;
+};
+
+// piecewise-linear function in flat sorted arrays: segment k covers [breakpoints[k], breakpoints[k + 1]) and adds offsets[k]
+struct SegmentTable {
+    std::vector<long> breakpoints{std::numeric_limits<long>::min()};
+    std::vector<long> offsets{0};
+
+    // appends a segment starting at breakpoint, which must not be smaller than the last one; equal neighbours are merged
+    void addSegment(long breakpoint, long offset) {
+        if (breakpoints.back() == breakpoint) {
+            offsets.back() = offset;
+            if (offsets.size() > 1 && offsets[offsets.size() - 2] == offset) {
+                breakpoints.pop_back();
+                offsets.pop_back();
+            }
+        } else if (offsets.back() != offset) {
+            breakpoints.push_back(breakpoint);
+            offsets.push_back(offset);
+        }
+    }
+
+    [[nodiscard]] std::size_t getSegment(long source) const {
+        return std::ranges::upper_bound(breakpoints, source) - breakpoints.begin() - 1;
+    }
+
+    [[nodiscard]] long getMapping(long source) const {
+        return source + offsets[getSegment(source)];
+    }
+
+    // pushes whole intervals through the function, splitting them at the segment boundaries
+    [[nodiscard]] std::vector<Interval> getMappings(const std::vector<Interval> &sources) const {
+        std::vector<Interval> mapped;
+        for (auto [begin, end]: sources) {
+            for (auto k = getSegment(begin); begin < end; ++k) {
+                auto segmentEnd = (k + 1 < breakpoints.size()) ? std::min(end, breakpoints[k + 1]) : end;
+                mapped.emplace_back(begin + offsets[k], segmentEnd + offsets[k]);
+                begin = segmentEnd;
+            }
+        }
+        return mapped;
+    }
+
+    // composition next(this(x)): every segment is split where its image crosses a breakpoint of next
+    [[nodiscard]] SegmentTable then(const SegmentTable &next) const {
+        SegmentTable composed;
+        for (std::size_t k{0}; k < breakpoints.size(); ++k) {
+            auto offset = offsets[k];
+            auto imageBegin = (k == 0) ? breakpoints[k] : breakpoints[k] + offset;
+            auto imageEnd = (k + 1 < breakpoints.size()) ? breakpoints[k + 1] + offset : std::numeric_limits<long>::max();
+
+            auto j = next.getSegment(imageBegin);
+            composed.addSegment(breakpoints[k], offset + next.offsets[j]);
+            for (++j; j < next.breakpoints.size() && next.breakpoints[j] < imageEnd; ++j)
+                composed.addSegment(next.breakpoints[j] - offset, offset + next.offsets[j]);
+        }
+        return composed;
+    }
+};
+
+// segment table in Eytzinger (BFS) order for batched point lookups. Node k holds a breakpoint together with the offset
+// of the segment ending there; the tree is padded to a full one, so every search takes exactly `levels` branch-free steps.
+class EytzingerTable {
+public:
+    explicit EytzingerTable(const SegmentTable &table) {
+        // the first breakpoint is the lowest possible value, so only the others need to be searched
+        auto n = table.breakpoints.size() - 1;
+        levels_ = std::bit_width(n);
+        keys_.assign(1uz << levels_, std::numeric_limits<long>::max());
+        offsetsBefore_.assign(1uz << levels_, table.offsets.back());// node 0: no breakpoint above the source
+
+        std::size_t j{1};
+        fill(1, table, j);
+    }
+
+    [[nodiscard]] long getMapping(long source) const {
+        std::size_t k{1};
+        for (std::size_t level{0}; level < levels_; ++level)
+            k = 2 * k + (keys_[k] <= source);
+        return source + offsetsBefore_[upperBoundNode(k)];
+    }
+
+    // several queries are walked down the tree in lock step, so their cache misses overlap
+    [[nodiscard]] std::vector<long> getMappings(const std::vector<long> &sources) const {
+        constexpr std::size_t batchSize{8};
+        std::vector<long> mapped(sources.size());
+
+        std::size_t i{0};
+        for (; i + batchSize <= sources.size(); i += batchSize) {
+            std::array<std::size_t, batchSize> k;
+            k.fill(1);
+            for (std::size_t level{0}; level < levels_; ++level) {
+                for (std::size_t q{0}; q < batchSize; ++q) {
+                    // the nodes four levels further down are 16 consecutive keys, i.e. two cache lines
+                    __builtin_prefetch(keys_.data() + std::min(16 * k[q], keys_.size() - 1));
+                    k[q] = 2 * k[q] + (keys_[k[q]] <= sources[i + q]);
+                }
+            }
+            for (std::size_t q{0}; q < batchSize; ++q)
+                mapped[i + q] = sources[i + q] + offsetsBefore_[upperBoundNode(k[q])];
+        }
+        for (; i < sources.size(); ++i)
+            mapped[i] = getMapping(sources[i]);
+
+        return mapped;
+    }
+
+private:
+    // in-order traversal of the implicit tree assigns the sorted breakpoints, the remaining nodes keep the padding
+    void fill(std::size_t k, const SegmentTable &table, std::size_t &j) {
+        if (k >= keys_.size()) return;
+        fill(2 * k, table, j);
+        if (j < table.breakpoints.size()) {
+            keys_[k] = table.breakpoints[j];
+            offsetsBefore_[k] = table.offsets[j - 1];
+            ++j;
+        }
+        fill(2 * k + 1, table, j);
+    }
+
+    // strip the trailing right turns plus the last left turn to get the first node greater than the source
+    [[nodiscard]] static std::size_t upperBoundNode(std::size_t k) {
+        return k >> (std::countr_one(k) + 1);
+    }
+
+    std::size_t levels_{0};
+    std::vector<long> keys_, offsetsBefore_;
+};
+
 struct AlmanacMap {
     void addRange(long dest, long source, long len) {
         source2range[source] = dest;
@@ -17,19 +150,11 @@ struct AlmanacMap {
             source2range[source + len] = source + len;
     }
 
-    [[nodiscard]] long getMapping(long source) const {
-        auto itNotLess = source2range.lower_bound(source);
-        auto itGreater = source2range.upper_bound(source);
-
-        if (itNotLess == itGreater && itNotLess != source2range.begin())// both bigger than source, go to previous
-            --itNotLess;
-
-        if (itNotLess == source2range.end())// no entry
-            return source;
-        else {
-            auto &[key, value] = *itNotLess;
-            return value + (source - key);
-        }
+    [[nodiscard]] SegmentTable getSegments() const {
+        SegmentTable segments;// identity before the first entry
+        for (const auto &[key, value]: source2range)
+            segments.addSegment(key, value - key);
+        return segments;
     }
 
     std::string name;
@@ -39,6 +164,7 @@ struct AlmanacMap {
 struct Almanac {
     std::vector<long> seeds{};
     std::vector<AlmanacMap> maps{};
+    SegmentTable seedToLocation{};// all maps composed into one function
 };
 
 auto splitIntString(std::string_view sv, std::string_view sep) {
@@ -79,37 +205,33 @@ auto parseInput(std::string_view filename) {
         }
     }
 
+    for (const auto &m: almanac.maps)
+        almanac.seedToLocation = almanac.seedToLocation.then(m.getSegments());
+
     return almanac;
 }
 
 auto solvePart1(const Almanac &almanac) {
     long locationNumber{std::numeric_limits<long>::max()};
 
-    for (auto s: almanac.seeds) {
-        long number{s};
-        for (const auto &m: almanac.maps)
-            number = m.getMapping(number);
-
-        locationNumber = std::min(locationNumber, number);
-    }
+    EytzingerTable search(almanac.seedToLocation);
+    for (auto location: search.getMappings(almanac.seeds))
+        locationNumber = std::min(locationNumber, location);
 
     return locationNumber;
 }
 
 auto solvePart2(const Almanac &almanac) {
-    // note: really slow -> should implement path compression through the maps, but alas, no time
-    long locationNumber{std::numeric_limits<long>::max()};
-
-    for (std::size_t i{0}; i < almanac.seeds.size(); i += 2) {
-        for (long s{almanac.seeds[i]}; s < almanac.seeds[i] + almanac.seeds[i + 1]; ++s) {
-            long number{s};
-            for (const auto &m: almanac.maps)
-                number = m.getMapping(number);
-
-            locationNumber = std::min(locationNumber, number);
-        }
+    std::vector<Interval> intervals;
+    for (std::size_t i{0}; i + 1 < almanac.seeds.size(); i += 2) {
+        if (almanac.seeds[i + 1] > 0)
+            intervals.emplace_back(almanac.seeds[i], almanac.seeds[i] + almanac.seeds[i + 1]);
     }
 
+    long locationNumber{std::numeric_limits<long>::max()};
+    for (const auto &interval: almanac.seedToLocation.getMappings(intervals))
+        locationNumber = std::min(locationNumber, interval.begin);
+
     return locationNumber;
 }
 
@@ -1,18 +1,21 @@
+#include <algorithm>
 #include <charconv>
+#include <cmath>
 #include <fstream>
 #include <print>
 #include <ranges>
 #include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 
 struct Race {
-    int time{0};
-    int distance{0};
+    long time{0};
+    long distance{0};
 };
 
 auto splitIntString(std::string_view sv, std::string_view sep) {
-    return sv | std::views::split(sep) | std::views::filter([](auto v) { return !v.empty(); }) | std::views::transform([](auto v) { int i{0}; std::from_chars(v.data(), v.data() + v.size(), i); return i; }) | std::ranges::to<std::vector<int>>();
+    return sv | std::views::split(sep) | std::views::filter([](auto v) { return !v.empty(); }) | std::views::transform([](auto v) { long i{0}; std::from_chars(v.data(), v.data() + v.size(), i); return i; }) | std::ranges::to<std::vector<long>>();
 }
 
 auto parseInput(std::string_view filename) {
@@ -37,18 +40,50 @@ auto parseInput(std::string_view filename) {
     return races;
 }
 
+// floor(sqrt(n)) for n >= 0: Newton steps refine the floating-point estimate, the final loops make it exact
+__int128 isqrt(__int128 n) {
+    if (n < 2) return n;
+    auto r = std::max(static_cast<__int128>(std::sqrt(static_cast<double>(n))), static_cast<__int128>(1));
+    for (int i{0}; i < 3; ++i)
+        r = (r + n / r) / 2;
+    while (r * r > n) --r;
+    while ((r + 1) * (r + 1) <= n) ++r;
+    return r;
+}
+
+// exact range [x1, x2] of hold times beating the distance, x1 > x2 if there is none.
+// Holding x gives x * (time - x), so the range is symmetric around time / 2.
 std::pair<long, long> evaluateRace(long time, long distance) {
-    long x1 = std::floor((0.5 * (time - std::sqrt(time * time - 4 * distance)) + 1.0));
-    long x2 = std::ceil((0.5 * (time + std::sqrt(time * time - 4 * distance)) - 1.0));
-    return {x1, x2};
+    auto beats = [&](__int128 x) { return x * (time - x) > distance; };
+
+    __int128 discriminant = static_cast<__int128>(time) * time - 4 * static_cast<__int128>(distance);
+    if (time < 0 || discriminant <= 0)
+        return {1, 0};
+
+    // boundary correction: the root estimate is off by at most one
+    __int128 x1 = std::max((time - isqrt(discriminant)) / 2, static_cast<__int128>(0));
+    while (x1 > 0 && beats(x1 - 1)) --x1;
+    while (x1 <= time / 2 && !beats(x1)) ++x1;
+
+    return {static_cast<long>(x1), static_cast<long>(time - x1)};
+}
+
+long countWays(const Race &race) {
+    auto [x1, x2] = evaluateRace(race.time, race.distance);
+    return (x1 <= x2) ? (x2 - x1 + 1) : 0;
+}
+
+std::vector<long> countWays(const std::vector<Race> &races) {
+    std::vector<long> ways(races.size());
+    for (std::size_t i{0}; i < races.size(); ++i)
+        ways[i] = countWays(races[i]);
+    return ways;
 }
 
 auto solvePart1(const std::vector<Race> &races) {
     long product{1};
-    for (const auto &race: races) {
-        auto [x1, x2] = evaluateRace(race.time, race.distance);
-        product *= (x2 - x1 + 1);
-    }
+    for (auto ways: countWays(races))
+        product *= ways;
 
     return product;
 }
@@ -59,11 +94,8 @@ auto solvePart2(const std::vector<Race> &races) {
         timeStr += std::to_string(r.time);
         distanceStr += std::to_string(r.distance);
     }
-    long time = std::stol(timeStr);
-    long distance = std::stol(distanceStr);
 
-    auto [x1, x2] = evaluateRace(time, distance);
-    return (x2 - x1 + 1);
+    return countWays(Race{std::stol(timeStr), std::stol(distanceStr)});
 }
 
 int main() {
@@ -5,98 +5,106 @@
 #include <string_view>
 #include <ranges>
 #include <algorithm>
-#include <unordered_map>
-#include <map>
-#include <set>
+#include <array>
+#include <cstdint>
+#include <numeric>
 
 enum Card { joker, two, three, four, five, six, seven, eight, nine, ten, jack, queen, king, ace};
 enum Type { highCard, onePair, twoPair, threeOfAKind, fullHouse, fourOfAKind, fiveOfAKind };
 
+constexpr auto charToCard = [] {
+    using enum Card;
+    std::array<Card, 256> table{};// unknown characters map to joker, which Hand rejects
+    table['2'] = two; table['3'] = three; table['4'] = four; table['5'] = five; table['6'] = six; table['7'] = seven;
+    table['8'] = eight; table['9'] = nine; table['T'] = ten; table['J'] = jack; table['Q'] = queen; table['K'] = king; table['A'] = ace;
+    return table;
+}();
+
+// type by the largest and second largest count of equal non-joker cards and the number of jokers,
+// which always join the largest group. The second largest count of five cards is at most 2.
+constexpr auto typeTable = [] {
+    using enum Type;
+    std::array<std::array<std::array<Type, 6>, 3>, 6> table{};
+    for (int largest{0}; largest <= 5; ++largest) {
+        for (int second{0}; second <= 2; ++second) {
+            for (int jokers{0}; jokers + largest <= 5; ++jokers) {
+                Type t;
+                switch (largest + jokers) {
+                    case 5:  t = fiveOfAKind; break;
+                    case 4:  t = fourOfAKind; break;
+                    case 3:  t = (second == 2) ? fullHouse : threeOfAKind; break;
+                    case 2:  t = (second == 2) ? twoPair : onePair; break;
+                    default: t = highCard; break;
+                }
+                table[largest][second][jokers] = t;
+            }
+        }
+    }
+    return table;
+}();
+
 struct Hand {
     std::array<Card, 5> cards;
     Type type;
     int bid;
 
+    // only the 13 real cards are accepted: joker is not a card of the input and would break the dense ranking digits
     Hand(std::string_view line) {
-        using enum Card;
-        std::unordered_map<char, Card> c2c{ {'2', two}, {'3', three}, {'4', four}, {'5', five}, {'6', six}, {'7', seven}, {'8', eight}, {'9', nine},
-                                            {'T', ten}, {'J', jack}, {'Q', queen}, {'K', king}, {'A', ace} };
-        for (std::size_t i{0}; i < 5; ++i)
-            cards[i] = c2c[line[i]];
+        if (line.size() < 6)
+            throw std::runtime_error("Invalid hand " + std::string(line));
+        for (std::size_t i{0}; i < 5; ++i) {
+            cards[i] = charToCard[static_cast<unsigned char>(line[i])];
+            if (cards[i] == Card::joker)
+                throw std::runtime_error("Invalid card in hand " + std::string(line));
+        }
 
         bid = std::stoi(std::string(line.substr(5)));
 
         type = determineType();
     }
 
-    Type determineType(bool withJokers = false) {
-        std::map<Card, int> numbers;
-        for (auto& c : cards)
-            numbers[c]++;
+    [[nodiscard]] Type determineType(bool withJokers = false) const {
+        std::array<std::uint8_t, 14> counts{};
+        for (auto c : cards)
+            ++counts[c];
 
-        std::multiset<int> types;
-        for (auto& [card, num] : numbers) {
-            if (withJokers && card == Card::joker)
-                continue;
-            types.insert(num);
+        int jokers{0};
+        if (withJokers) {
+            jokers = counts[Card::joker];
+            counts[Card::joker] = 0;
         }
 
-        Type t;
-        using enum Type;
-        if (types.empty())
-            t = Type::highCard;
-        else {
-            auto typesIt = types.crbegin();
-            switch (*typesIt) {
-                case 5:  t = fiveOfAKind; break;
-                case 4:  t = fourOfAKind; break;
-                case 3:  t = threeOfAKind; break;
-                case 2:  t = onePair; break;
-                default: t = highCard; break;
-            }
-
-            if (typesIt != types.crend()) {
-                ++typesIt;
-                if (t == onePair && *typesIt == 2) t = twoPair;
-                if (t == threeOfAKind && *typesIt == 2) t = fullHouse;
-            }
+        int largest{0}, second{0};
+        for (auto count : counts) {
+            if (count > largest) {
+                second = largest;
+                largest = count;
+            } else if (count > second)
+                second = count;
         }
 
-        if (withJokers) {
-            int countJokers = numbers[Card::joker];
-
-            if (countJokers >= 4) t = fiveOfAKind;
-            if (countJokers == 3) {
-                if (t >= onePair) t = fiveOfAKind;
-                else t = fourOfAKind;
-            }
-            if (countJokers == 2) {
-                if (t >= threeOfAKind) t = fiveOfAKind;
-                else if (t >= onePair) t = fourOfAKind;
-                else t = threeOfAKind;
-            }
-            if (countJokers == 1) {
-                if (t >= fourOfAKind)t = fiveOfAKind;
-                else if (t >= threeOfAKind) t = fourOfAKind;
-                else if (t == twoPair) t = fullHouse;
-                else if (t == onePair) t = threeOfAKind;
-                else t = onePair;
-            }
-        }
+        return typeTable[largest][std::min(second, 2)][jokers];
+    }
 
-        return t;
+    // packed ranking key: type in bits 20 to 22, below it the five card ranks as 4-bit digits, first card highest
+    [[nodiscard]] std::uint32_t key() const {
+        std::uint32_t k = type;
+        for (auto c : cards)
+            k = (k << 4) | c;
+        return k;
     }
-};
 
-bool operator<(const Hand& lhs, const Hand& rhs) {
-    if (lhs.type != rhs.type)
-        return lhs.type < rhs.type;
-    for (std::size_t i{0}; i < 5; ++i) {
-        if (lhs.cards[i] != rhs.cards[i])
-            return lhs.cards[i] < rhs.cards[i];
+    // the same hand under the joker rules: jacks become jokers and the type is redetermined
+    [[nodiscard]] Hand withJokers() const {
+        Hand h{*this};
+        for (auto& c : h.cards) {
+            if (c == Card::jack)
+                c = Card::joker;
+        }
+        h.type = h.determineType(true);
+        return h;
     }
-    return false;
-}
+};
 
 auto parseInput(std::string_view filename) {
     std::ifstream infile(filename);
@@ -116,28 +124,148 @@ auto parseInput(std::string_view filename) {
 }
 
 
-auto solvePart1(std::vector<Hand>& hands) {
-    std::sort(hands.begin(), hands.end());
+struct RankedHand {
+    std::uint32_t key;
+    std::uint32_t bid;
+};
 
-    unsigned winnings{0};
-    for (std::size_t i{0}; i < hands.size(); ++i) {
-        winnings += (i+1) * hands[i].bid;
+// LSD radix sort over the 24 key bits in three stable passes of 8 bits, bids move along with their keys
+void radixSort(std::vector<RankedHand>& entries) {
+    std::vector<RankedHand> buffer(entries.size());
+    for (unsigned shift{0}; shift < 24; shift += 8) {
+        std::array<std::size_t, 257> offsets{};
+        for (const auto& e : entries)
+            ++offsets[((e.key >> shift) & 0xff) + 1];
+        std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+        for (const auto& e : entries)
+            buffer[offsets[(e.key >> shift) & 0xff]++] = e;
+        entries.swap(buffer);
+    }
+}
+
+auto solvePart1(const std::vector<Hand>& hands) {
+    std::vector<RankedHand> entries;
+    entries.reserve(hands.size());
+    for (const auto& h : hands)
+        entries.emplace_back(h.key(), static_cast<std::uint32_t>(h.bid));
+    radixSort(entries);
+
+    std::uint64_t winnings{0};
+    for (std::size_t i{0}; i < entries.size(); ++i) {
+        winnings += (i+1) * entries[i].bid;
     }
 
     return winnings;
 }
 
-auto solvePart2(std::vector<Hand>& hands) {
-    for (auto& h : hands) {
-        for (auto& c : h.cards) {
-            if (c == Card::jack)
-                c = Card::joker;
+auto solvePart2(const std::vector<Hand>& hands) {
+    std::vector<Hand> jokerHands;
+    jokerHands.reserve(hands.size());
+    for (const auto& h : hands)
+        jokerHands.push_back(h.withJokers());
+
+    return solvePart1(jokerHands);
+}
+
+// live ranking under one rule set. Fenwick trees over the dense hand index (type and five base-13 card digits) count the
+// hands and sum their bids, which is all that is needed to keep the total winnings sum(rank * bid) up to date in O(log n).
+// Hands must be distinct, as ties would make the ranking ambiguous.
+class RankingView {
+public:
+    explicit RankingView(bool withJokers) : withJokers_(withJokers), counts_(noIndices + 1, 0), bids_(noIndices + 1, 0) {}
+
+    void insert(const Hand& hand) {
+        auto index = getIndex(hand);
+        if (getCount(index) != 0)
+            throw std::runtime_error("Hand is already ranked");
+        std::uint64_t bid = hand.bid;
+
+        // the new hand sits above all smaller ones and pushes every larger one up by a rank
+        totalWinnings_ += bid * (1 + getCountBelow(index)) + (bidsTotal_ - getBidsUpTo(index));
+        add(index, 1, bid);
+        bidsTotal_ += bid;
+        ++size_;
+    }
+
+    void remove(const Hand& hand) {
+        auto index = getIndex(hand);
+        if (getCount(index) == 0)
+            throw std::runtime_error("Hand is not ranked");
+        // the bid must be the one that was inserted, otherwise the bid sums would drift
+        std::uint64_t bid = getBidsUpTo(index) - getBidsUpTo(index - 1);
+        if (bid != static_cast<std::uint64_t>(hand.bid))
+            throw std::runtime_error("Hand is ranked with a different bid");
+
+        add(index, -1, -bid);
+        bidsTotal_ -= bid;
+        --size_;
+        totalWinnings_ -= bid * (1 + getCountBelow(index)) + (bidsTotal_ - getBidsUpTo(index));
+    }
+
+    [[nodiscard]] std::uint64_t getTotalWinnings() const { return totalWinnings_; }
+    [[nodiscard]] std::size_t size() const { return size_; }
+
+private:
+    static constexpr std::size_t noIndices{7 * 13 * 13 * 13 * 13 * 13};
+
+    // same order as Hand::key, but with the 13 ranks of the rule set as dense digits
+    [[nodiscard]] std::size_t getIndex(const Hand& hand) const {
+        auto h = withJokers_ ? hand.withJokers() : hand;
+        std::size_t index = h.type;
+        for (auto c : h.cards)
+            index = 13 * index + (withJokers_ ? c - (c > Card::jack) : c - 1);
+        return index + 1;// Fenwick trees are 1-based
+    }
+
+    void add(std::size_t index, std::uint32_t count, std::uint64_t bid) {
+        for (; index < counts_.size(); index += index & -index) {
+            counts_[index] += count;
+            bids_[index] += bid;
         }
-        h.type = h.determineType(true);
     }
 
-    return solvePart1(hands);
-}
+    [[nodiscard]] std::uint32_t getCountBelow(std::size_t index) const {
+        std::uint32_t count{0};
+        for (--index; index > 0; index -= index & -index)
+            count += counts_[index];
+        return count;
+    }
+
+    [[nodiscard]] std::uint64_t getBidsUpTo(std::size_t index) const {
+        std::uint64_t bids{0};
+        for (; index > 0; index -= index & -index)
+            bids += bids_[index];
+        return bids;
+    }
+
+    [[nodiscard]] std::uint32_t getCount(std::size_t index) const {
+        std::uint32_t count{0};
+        for (auto i = index; i > 0; i -= i & -i)
+            count += counts_[i];
+        return count - getCountBelow(index);
+    }
+
+    bool withJokers_;
+    std::vector<std::uint32_t> counts_;// unsigned wrap-around makes removals plain additions
+    std::vector<std::uint64_t> bids_;
+    std::uint64_t bidsTotal_{0}, totalWinnings_{0};
+    std::size_t size_{0};
+};
+
+// continuously updated leaderboard with one view per rule set
+struct Leaderboard {
+    RankingView normal{false}, jokers{true};
+
+    void insert(const Hand& hand) {
+        normal.insert(hand);
+        jokers.insert(hand);
+    }
+
+    void remove(const Hand& hand) {
+        normal.remove(hand);
+        jokers.remove(hand);
+    }
+};
 
 int main() {
     std::println("AoC 2023: 07");
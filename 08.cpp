@@ -5,14 +5,36 @@
 #include <unordered_map>
 #include <vector>
 #include <numeric>
+#include <optional>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <queue>
+#include <span>
+#include <functional>
 
-struct Node {
-    std::string left, right;
-};
-
+// network with node names packed into dense indices at parse time: a step is a single array load
 struct Map {
-    std::string instructions;
-    std::unordered_map<std::string, Node> nodes;
+    std::vector<bool> instructions;// bit array, true for 'R'
+    std::vector<std::uint32_t> left, right;
+    std::vector<bool> isStart, isEnd;// ??A and ??Z nodes
+    std::vector<std::string> names;
+
+    [[nodiscard]] std::uint32_t step(std::uint32_t node, std::size_t instructionIndex) const {
+        return instructions[instructionIndex] ? right[node] : left[node];
+    }
+
+    [[nodiscard]] std::uint32_t getIndex(std::string_view name) const {
+        auto it = std::ranges::find(names, name);
+        if (it == names.end())
+            throw std::runtime_error("Unknown node " + std::string(name));
+        return static_cast<std::uint32_t>(it - names.begin());
+    }
 };
 
 auto parseInput(std::string_view fileName) {
@@ -23,89 +45,285 @@ auto parseInput(std::string_view fileName) {
     Map map;
     std::string line;
     std::getline(infile, line);
-    map.instructions = std::move(line);
+    for (auto c: line)
+        map.instructions.push_back(c == 'R');
+
+    std::unordered_map<std::string, std::uint32_t> indices;// only needed while parsing
+    auto getIndex = [&](const std::string& name) {
+        auto [it, inserted] = indices.try_emplace(name, static_cast<std::uint32_t>(map.names.size()));
+        if (inserted) {
+            map.names.push_back(name);
+            map.left.push_back(it->second);
+            map.right.push_back(it->second);
+            map.isStart.push_back(name.size() == 3 && name[2] == 'A');
+            map.isEnd.push_back(name.size() == 3 && name[2] == 'Z');
+        }
+        return it->second;
+    };
 
     while (!infile.eof()) {
         std::getline(infile, line);
         if (line.empty()) continue;
 
-        Node node{line.substr(7, 3), line.substr(12, 3)}; // hardcoded, boo...
-        map.nodes[line.substr(0, 3)] = std::move(node);
+        auto node = getIndex(line.substr(0, 3)); // hardcoded, boo...
+        auto left = getIndex(line.substr(7, 3));
+        auto right = getIndex(line.substr(12, 3));
+        map.left[node] = left;
+        map.right[node] = right;
     }
 
     return map;
 }
 
-auto solvePart1(Map& map) {
-    int noSteps{0};
-    std::string currentNode{"AAA"};
-    for (int i{0}; i < static_cast<int>(map.instructions.size()); ++i) {
+auto solvePart1(const Map& map) {
+    auto currentNode = map.getIndex("AAA");
+    auto endNode = map.getIndex("ZZZ");
+
+    long noSteps{0};
+    for (std::size_t i{0}; currentNode != endNode; i = (i + 1) % map.instructions.size()) {
+        currentNode = map.step(currentNode, i);
         ++noSteps;
-        if (map.instructions[i] == 'L')
-            currentNode = map.nodes[currentNode].left;
-        else
-            currentNode = map.nodes[currentNode].right;
-        if (currentNode == "ZZZ")
-            break;
-        if (i == map.instructions.size() - 1) // wrap around instructions
-            i = -1;
     }
 
     return noSteps;
 }
 
-std::vector<std::string> findStartNodes(const Map& map) {
-    std::vector<std::string> startNodes;
-    for (const auto& [key, node]: map.nodes) {
-        if (key.size() == 3 && key[2] == 'A')
-            startNodes.push_back(key);
+// binary lifting over full instruction cycles: jumps[k][node] is the node reached after 2^k cycles.
+// The position after N steps then takes O(log N) jumps plus fewer than one cycle of single steps.
+// The table keeps its own copy of the instructions and links, and holds levels for up to maxSteps steps.
+class JumpTable {
+public:
+    JumpTable(const Map& map, std::uint64_t maxSteps) : instructions_(map.instructions), left_(map.left), right_(map.right) {
+        std::vector<std::uint32_t> cycle(left_.size());
+        for (std::uint32_t node{0}; node < cycle.size(); ++node) {
+            auto currentNode{node};
+            for (std::size_t i{0}; i < instructions_.size(); ++i)
+                currentNode = step(currentNode, i);
+            cycle[node] = currentNode;
+        }
+
+        auto noLevels = std::max(static_cast<std::size_t>(std::bit_width(maxSteps / instructions_.size())), 1uz);
+        jumps_.reserve(noLevels);
+        jumps_.push_back(std::move(cycle));
+        while (jumps_.size() < noLevels) {
+            const auto& previous = jumps_.back();
+            std::vector<std::uint32_t> next(previous.size());
+            for (std::size_t node{0}; node < next.size(); ++node)
+                next[node] = previous[previous[node]];
+            jumps_.push_back(std::move(next));
+        }
+    }
+
+    [[nodiscard]] std::uint32_t getPosition(std::uint32_t startNode, std::uint64_t noSteps) const {
+        auto noCycles = noSteps / instructions_.size();
+        if (static_cast<std::size_t>(std::bit_width(noCycles)) > jumps_.size())
+            throw std::runtime_error("Number of steps exceeds the jump table");
+
+        auto currentNode{startNode};
+        for (std::size_t k{0}; noCycles > 0; ++k, noCycles >>= 1) {
+            if (noCycles & 1)
+                currentNode = jumps_[k][currentNode];
+        }
+        for (std::size_t i{0}; i < noSteps % instructions_.size(); ++i)
+            currentNode = step(currentNode, i);
+
+        return currentNode;
+    }
+
+private:
+    [[nodiscard]] std::uint32_t step(std::uint32_t node, std::size_t instructionIndex) const {
+        return instructions_[instructionIndex] ? right_[node] : left_[node];
+    }
+
+    std::vector<bool> instructions_;
+    std::vector<std::uint32_t> left_, right_;
+    std::vector<std::vector<std::uint32_t>> jumps_;
+};
+
+std::vector<std::uint32_t> findStartNodes(const Map& map) {
+    std::vector<std::uint32_t> startNodes;
+    for (std::uint32_t node{0}; node < map.isStart.size(); ++node) {
+        if (map.isStart[node])
+            startNodes.push_back(node);
     }
     return startNodes;
 }
 
-auto getCycleLength(std::string startNode, Map& map) {
-    std::string currentNode{std::move(startNode)};
-    unsigned instructionIndex{0};
-    // find end node with ??Z
-    while (currentNode.size() == 3 && currentNode[2] != 'Z') {
-        if (map.instructions[instructionIndex] == 'L')
-            currentNode = map.nodes[currentNode].left;
-        else
-            currentNode = map.nodes[currentNode].right;
-        instructionIndex = (instructionIndex + 1) % map.instructions.size();
-    }
-    std::string endNode{currentNode};
-
-    // count number of steps to get to that end node again
-    int noSteps{0};
-    while (currentNode != endNode || noSteps == 0) {
-        ++noSteps;
-        if (map.instructions[instructionIndex] == 'L')
-            currentNode = map.nodes[currentNode].left;
-        else
-            currentNode = map.nodes[currentNode].right;
-        instructionIndex = (instructionIndex + 1) % map.instructions.size();
+// exact walk structure of one ghost over (node, instruction index) states: from step `tail` on the walk repeats
+// with `period`, which is a multiple of the instruction length. Hits are the steps at which the ghost is on a ??Z node.
+struct GhostCycle {
+    std::uint64_t tail{0}, period{0};
+    std::vector<std::uint64_t> tailHits; // hits before tail
+    std::vector<std::uint64_t> cycleHits;// hits in [tail, tail + period)
+
+    [[nodiscard]] bool isHit(std::uint64_t noSteps) const {
+        if (noSteps < tail)
+            return std::ranges::binary_search(tailHits, noSteps);
+        return std::ranges::binary_search(cycleHits, tail + (noSteps - tail) % period);
     }
+};
 
-    return noSteps;
+GhostCycle analyzeGhost(std::uint32_t startNode, const Map& map) {
+    const auto noInstructions = map.instructions.size();
+    auto walkCycle = [&](std::uint32_t node) {
+        for (std::size_t i{0}; i < noInstructions; ++i)
+            node = map.step(node, i);
+        return node;
+    };
+
+    // the nodes at the start of each instruction cycle repeat first, which fixes the period. Only the ghost's own
+    // cycle starts are recorded, so analyzing many ghosts does not cost a pass over the whole network each.
+    std::unordered_map<std::uint32_t, std::uint64_t> seenAtCycle;
+    std::vector<std::uint32_t> cycleStarts;
+    for (auto node{startNode}; seenAtCycle.try_emplace(node, cycleStarts.size()).second; node = walkCycle(node))
+        cycleStarts.push_back(node);
+    auto firstRepeat = seenAtCycle[walkCycle(cycleStarts.back())];
+
+    GhostCycle ghost;
+    ghost.period = (cycleStarts.size() - firstRepeat) * noInstructions;
+
+    // the exact tail ends within the instruction cycle before the first repeated cycle start
+    ghost.tail = firstRepeat * noInstructions;
+    if (firstRepeat > 0) {
+        auto node = cycleStarts[firstRepeat - 1], later = cycleStarts.back();
+        ghost.tail -= noInstructions;
+        for (std::size_t i{0}; node != later; ++i, ++ghost.tail) {
+            node = map.step(node, i);
+            later = map.step(later, i);
+        }
+    }
+
+    auto node{startNode};
+    for (std::uint64_t noSteps{0}; noSteps < ghost.tail + ghost.period; ++noSteps) {
+        if (map.isEnd[node])
+            (noSteps < ghost.tail ? ghost.tailHits : ghost.cycleHits).push_back(noSteps);
+        node = map.step(node, noSteps % noInstructions);
+    }
+
+    return ghost;
+}
+
+__int128 modularInverse(__int128 a, __int128 m) {
+    __int128 oldR{a % m}, r{m}, oldS{1}, s{0};
+    while (r != 0) {
+        auto q = oldR / r;
+        std::tie(oldR, r) = std::pair{r, oldR - q * r};
+        std::tie(oldS, s) = std::pair{s, oldS - q * s};
+    }
+    return ((oldS % m) + m) % m;
 }
 
-auto lcm(const std::vector<int>& numbers) {
-    if (numbers.size() < 2) return 0l;
-    long lcm = std::lcm(numbers[0], numbers[1]);
-    for (std::size_t i{2}; i < numbers.size(); ++i)
-        lcm = std::lcm(lcm, numbers[i]);
-    return lcm;
+// generalized CRT for non-coprime moduli: x = r1 mod m1 and x = r2 mod m2, if solvable
+std::optional<std::pair<__int128, __int128>> combineResidues(__int128 r1, __int128 m1, __int128 r2, __int128 m2) {
+    auto g = std::gcd(m1, m2);
+    if ((r2 - r1) % g != 0)
+        return std::nullopt;
+    if (m1 / g > std::numeric_limits<__int128>::max() / m2)
+        throw std::runtime_error("Ghost synchronization period exceeds 128 bits");
+
+    auto m2g = m2 / g;
+    auto k = ((((r2 - r1) / g) % m2g + m2g) % m2g) * modularInverse((m1 / g) % m2g, m2g) % m2g;
+    auto lcm = m1 * m2g;
+    return std::pair{(r1 + m1 * k) % lcm, lcm};
 }
 
-auto solvePart2(Map& map) {
-    auto currentNodes = findStartNodes(map);
-    std::vector<int> cycleLengths;
-    cycleLengths.reserve(currentNodes.size());
-    for (const auto& node : currentNodes)
-        cycleLengths.emplace_back(getCycleLength(node, map));
+// residue sets larger than this are not combined any further, the remaining ghosts are checked per candidate step
+constexpr std::size_t maxResidues{1 << 12};
+
+std::uint64_t synchronizeGhosts(const std::vector<GhostCycle>& ghosts) {
+    if (ghosts.empty())
+        throw std::runtime_error("No ghosts to synchronize");
+
+    // before the longest tail, only that ghost's tail hits can work
+    const auto& longest = *std::ranges::max_element(ghosts, {}, &GhostCycle::tail);
+    for (auto noSteps : longest.tailHits) {
+        if (std::ranges::all_of(ghosts, [&](const auto& g) { return g.isHit(noSteps); }))
+            return noSteps;
+    }
+
+    // ghosts with few cycle hits constrain the most and keep the combined residue set small
+    std::vector<const GhostCycle*> order;
+    for (const auto& ghost : ghosts)
+        order.push_back(&ghost);
+    std::ranges::stable_sort(order, {}, [](const auto* g) { return g->cycleHits.size(); });
+
+    // from there on every ghost is periodic: combine the residues of the cycle hits while the set stays small
+    std::vector<std::pair<__int128, __int128>> residues{{0, 1}};
+    std::size_t noCombined{0};
+    for (; noCombined < order.size(); ++noCombined) {
+        const auto& ghost = *order[noCombined];
+        if (noCombined > 0 && residues.size() * ghost.cycleHits.size() > maxResidues)
+            break;
+
+        std::vector<std::pair<__int128, __int128>> combined;
+        for (const auto& [r, m] : residues) {
+            for (auto hit : ghost.cycleHits) {
+                if (auto c = combineResidues(r, m, hit % ghost.period, ghost.period))
+                    combined.push_back(*c);
+            }
+        }
+        std::ranges::sort(combined);
+        auto [first, last] = std::ranges::unique(combined);
+        combined.erase(first, last);
+        residues = std::move(combined);
+        if (residues.empty())
+            throw std::runtime_error("Ghosts never synchronize");
+    }
+
+    // the first step >= longest.tail of each residue class, smallest first
+    using Candidate = std::pair<__int128, __int128>;// step and its modulus
+    std::priority_queue<Candidate, std::vector<Candidate>, std::greater<>> candidates;
+    for (const auto& [r, m] : residues) {
+        __int128 noSteps = r;
+        if (noSteps < longest.tail)
+            noSteps += (longest.tail - noSteps + m - 1) / m * m;
+        candidates.emplace(noSteps, m);
+    }
+
+    // the remaining ghosts are tested step by step; all ghosts repeat after the lcm of their periods,
+    // so if no candidate within one such period from the tail works, none ever will
+    constexpr auto maxSteps{std::numeric_limits<__int128>::max()};
+    __int128 period{1};
+    for (const auto& ghost : ghosts) {
+        auto factor = static_cast<__int128>(ghost.period) / std::gcd(period, static_cast<__int128>(ghost.period));
+        period = (period > maxSteps / factor) ? maxSteps : period * factor;
+    }
+    auto syncEnd = (period > maxSteps - longest.tail) ? maxSteps : longest.tail + period;
+
+    const std::span remaining{order.begin() + noCombined, order.end()};
+    while (true) {
+        auto [noSteps, m] = candidates.top();
+        if (noSteps >= syncEnd)
+            throw std::runtime_error("Ghosts never synchronize");
+        if (noSteps > std::numeric_limits<std::uint64_t>::max())
+            throw std::runtime_error("Ghost synchronization exceeds 64 bits");
+        if (std::ranges::all_of(remaining, [&](const auto* g) { return g->isHit(static_cast<std::uint64_t>(noSteps)); }))
+            return static_cast<std::uint64_t>(noSteps);
+
+        candidates.pop();
+        candidates.emplace(noSteps + m, m);
+    }
+}
+
+// each ghost's cycle analysis only reads the shared network, so a pool of workers pulls ghosts off a shared counter
+auto analyzeGhosts(const std::vector<std::uint32_t>& startNodes, const Map& map) {
+    std::vector<GhostCycle> ghosts(startNodes.size());
+    std::atomic<std::size_t> nextGhost{0};
+    auto noWorkers = std::clamp<std::size_t>(std::thread::hardware_concurrency(), 1, std::max(startNodes.size(), 1uz));
+    {
+        std::vector<std::jthread> workers;
+        for (std::size_t w{0}; w < noWorkers; ++w) {
+            workers.emplace_back([&] {
+                for (auto g = nextGhost++; g < startNodes.size(); g = nextGhost++)
+                    ghosts[g] = analyzeGhost(startNodes[g], map);
+            });
+        }
+    }
+    return ghosts;
+}
 
-    return lcm(cycleLengths);
+auto solvePart2(const Map& map) {
+    return synchronizeGhosts(analyzeGhosts(findStartNodes(map), map));
 }
 
 int main() {
@@ -7,6 +7,10 @@
 #include <fstream>
 #include <numeric>
 #include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <map>
 
 auto splitIntString(std::string_view sv, std::string_view sep) {
     return sv | std::views::split(sep) | std::views::filter([](auto v) { return !v.empty(); })
@@ -31,43 +35,189 @@ auto parseInput(std::string_view fileName) {
     return sequences;
 }
 
-auto predictSequence(const std::vector<long>& sequence, bool end = true) {
-    std::vector<long> currentSequence, nextSequence{sequence};
-    std::vector<long> startNumbers, endNumbers;
-    startNumbers.emplace_back(nextSequence.front());
-    endNumbers.emplace_back(nextSequence.back());
-
-    do {
-        currentSequence = nextSequence;
-        nextSequence.clear();
-        nextSequence.reserve(currentSequence.size()-1);
-        for (std::size_t i{0}; i < currentSequence.size() - 1; ++i)
-            nextSequence.emplace_back(currentSequence[i+1] - currentSequence[i]);
-        endNumbers.emplace_back(nextSequence.back());
-        startNumbers.emplace_back(nextSequence.front());
-    } while (std::accumulate(nextSequence.begin(), nextSequence.end(), 0l,
-             [](auto a, auto b) { return std::abs(a) + std::abs(b); }) > 0l);
-
-    startNumbers.pop_back();
-    endNumbers.pop_back();
-    std::ranges::reverse(startNumbers);
-    std::ranges::reverse(endNumbers);
-
-    long prediction{0};
-    for (const auto &number: (end) ? endNumbers : startNumbers) {
-        prediction = number + ((end) ? prediction : -prediction);
+// for a fixed length n, both extrapolations are binomial-weighted dot products (the n-th difference vanishes):
+// next = sum_k (-1)^(n-1-k) C(n, k) x_k and previous = sum_k (-1)^k C(n, k+1) x_k
+struct ExtrapolationWeights {
+    static constexpr std::size_t maxLength{66};// C(67, 33) no longer fits into 64 bits
+
+    std::vector<std::int64_t> forward, backward;
+
+    explicit ExtrapolationWeights(std::size_t length) : forward(length), backward(length) {
+        if (length > maxLength)
+            throw std::runtime_error("Sequence too long for the extrapolation kernel");
+
+        std::vector<std::int64_t> binomials{1};// row `length` of Pascal's triangle
+        for (std::size_t i{1}; i <= length; ++i)
+            binomials.push_back(static_cast<std::int64_t>(static_cast<__int128>(binomials.back()) * (length - i + 1) / i));
+
+        for (std::size_t k{0}; k < length; ++k) {
+            forward[k] = ((length - 1 - k) % 2 == 0) ? binomials[k] : -binomials[k];
+            backward[k] = (k % 2 == 0) ? binomials[k + 1] : -binomials[k + 1];
+        }
+    }
+};
+
+// sequences of one length stored column-major, so each weight is applied to all sequences in one vectorizable loop
+struct SequenceBatch {
+    std::size_t length{0};
+    std::vector<long> values;// values[k * size() + s] is element k of sequence s
+
+    [[nodiscard]] std::size_t size() const { return values.size() / length; }
+};
+
+auto groupByLength(const std::vector<std::vector<long>>& sequences) {
+    std::map<std::size_t, std::vector<const std::vector<long>*>> byLength;
+    for (const auto& sequence : sequences) {
+        if (!sequence.empty())
+            byLength[sequence.size()].push_back(&sequence);
+    }
+
+    std::vector<SequenceBatch> batches;
+    for (const auto& [length, group] : byLength) {
+        SequenceBatch batch{length, std::vector<long>(length * group.size())};
+        for (std::size_t s{0}; s < group.size(); ++s) {
+            for (std::size_t k{0}; k < length; ++k)
+                batch.values[k * group.size() + s] = (*group[s])[k];
+        }
+        batches.push_back(std::move(batch));
+    }
+    return batches;
+}
+
+// the main loop wraps around in 64 bits and tracks a floating-point bound of sum |w_k x_k| alongside.
+// Only sequences whose bound gets near 2^63 are recomputed exactly in 128 bits, which also detects real overflow.
+std::vector<long> extrapolate(const SequenceBatch& batch, const std::vector<std::int64_t>& weights) {
+    const auto noSequences = batch.size();
+    std::vector<std::uint64_t> sums(noSequences, 0);
+    std::vector<double> bounds(noSequences, 0.0);
+    for (std::size_t k{0}; k < batch.length; ++k) {
+        const auto weight = weights[k];
+        const auto* column = batch.values.data() + k * noSequences;
+        for (std::size_t s{0}; s < noSequences; ++s) {
+            sums[s] += static_cast<std::uint64_t>(weight) * static_cast<std::uint64_t>(column[s]);
+            bounds[s] += std::abs(static_cast<double>(weight)) * std::abs(static_cast<double>(column[s]));
+        }
+    }
+
+    std::vector<long> predictions(noSequences);
+    for (std::size_t s{0}; s < noSequences; ++s) {
+        predictions[s] = static_cast<long>(sums[s]);
+        if (bounds[s] < 0x1p62) continue;
+
+        // each product stays below 2^126, but up to 66 of them can exceed 128 bits, so every addition is checked
+        __int128 exact{0};
+        bool overflow{false};
+        for (std::size_t k{0}; k < batch.length && !overflow; ++k)
+            overflow = __builtin_add_overflow(exact, static_cast<__int128>(weights[k]) * batch.values[k * noSequences + s], &exact);
+        if (overflow || exact < std::numeric_limits<long>::min() || exact > std::numeric_limits<long>::max())
+            throw std::runtime_error("Prediction overflows 64 bits");
+        predictions[s] = static_cast<long>(exact);
+    }
+    return predictions;
+}
+
+// extrapolator for series growing one value at a time. It keeps the last diagonal of the difference table
+// (backward differences of the newest value) and the first diagonal (forward differences of the oldest value).
+// Trailing zero differences are trimmed: together with the number of values they determine the rest of the
+// diagonal, so an append costs O(degree) of the values seen so far and predictions read straight off the diagonals.
+class StreamingExtrapolator {
+public:
+    // the new diagonal is built in a scratch buffer and only swapped in once no difference overflowed
+    void append(long value) {
+        // new diagonal: d'[0] = value, d'[j] = d'[j - 1] - d[j - 1]
+        nextDiagonal_.clear();
+        long current{value};
+        for (auto difference : lastDiagonal_) {
+            long next{0};
+            if (__builtin_sub_overflow(current, difference, &next))
+                throw std::runtime_error("Difference overflows 64 bits");
+            nextDiagonal_.push_back(current);
+            current = next;
+        }
+        // above the stored part d[j - 1] = 0, so every remaining entry up to the new order count_ equals current
+        if (current != 0)
+            nextDiagonal_.resize(count_ + 1, current);
+        lastDiagonal_.swap(nextDiagonal_);
+        ++count_;
+
+        // the j-th forward difference of the first value is complete once value j has arrived
+        const auto j = count_ - 1;
+        if (j < lastDiagonal_.size() && lastDiagonal_[j] != 0) {
+            firstDiagonal_.resize(j, 0);
+            firstDiagonal_.push_back(lastDiagonal_[j]);
+        }
+    }
+
+    [[nodiscard]] std::size_t size() const { return count_; }
+    [[nodiscard]] std::size_t degree() const { return lastDiagonal_.empty() ? 0 : lastDiagonal_.size() - 1; }
+
+    [[nodiscard]] long predictNext() const { return predictAhead(1); }
+
+    // Newton's backward formula: x[n + k] = sum_j C(k + j - 1, j) * (j-th backward difference of x[n])
+    [[nodiscard]] long predictAhead(std::size_t k) const {
+        __int128 prediction{0}, binomial{1};
+        for (std::size_t j{0}; j < lastDiagonal_.size(); ++j) {
+            __int128 term{0};
+            if (j > 0 && __builtin_mul_overflow(binomial, static_cast<__int128>(k + j - 1), &binomial))
+                throw std::runtime_error("Prediction overflows 64 bits");
+            if (j > 0)
+                binomial /= j;
+            if (__builtin_mul_overflow(binomial, static_cast<__int128>(lastDiagonal_[j]), &term)
+                || __builtin_add_overflow(prediction, term, &prediction))
+                throw std::runtime_error("Prediction overflows 64 bits");
+        }
+        return toLong(prediction);
     }
 
-    return prediction;
+    // x[-1] = sum_j (-1)^j * (j-th forward difference of x[0])
+    [[nodiscard]] long predictPrevious() const {
+        __int128 prediction{0};
+        for (std::size_t j{0}; j < firstDiagonal_.size(); ++j)
+            prediction += (j % 2 == 0) ? firstDiagonal_[j] : -static_cast<__int128>(firstDiagonal_[j]);
+        return toLong(prediction);
+    }
+
+private:
+    std::size_t count_{0};
+    std::vector<long> lastDiagonal_, firstDiagonal_;
+    std::vector<long> nextDiagonal_;// scratch space for append
+
+    static long toLong(__int128 value) {
+        if (value < std::numeric_limits<long>::min() || value > std::numeric_limits<long>::max())
+            throw std::runtime_error("Prediction overflows 64 bits");
+        return static_cast<long>(value);
+    }
+};
+
+// sequences too long for the binomial weights run through the difference table of the streaming extrapolator
+std::vector<long> extrapolateByDifferences(const SequenceBatch& batch, bool backward) {
+    const auto noSequences = batch.size();
+    std::vector<long> predictions(noSequences);
+    for (std::size_t s{0}; s < noSequences; ++s) {
+        StreamingExtrapolator extrapolator;
+        for (std::size_t k{0}; k < batch.length; ++k)
+            extrapolator.append(batch.values[k * noSequences + s]);
+        predictions[s] = backward ? extrapolator.predictPrevious() : extrapolator.predictNext();
+    }
+    return predictions;
 }
 
 auto solvePart1and2(const std::vector<std::vector<long>>& sequences, bool part2 = false) {
     long sum{0};
-    for (const auto& sequence : sequences)
-        sum += predictSequence(sequence, !part2);
+    for (const auto& batch : groupByLength(sequences)) {
+        if (batch.length > ExtrapolationWeights::maxLength) {
+            for (auto prediction : extrapolateByDifferences(batch, part2))
+                sum += prediction;
+            continue;
+        }
+        ExtrapolationWeights weights(batch.length);
+        for (auto prediction : extrapolate(batch, part2 ? weights.backward : weights.forward))
+            sum += prediction;
+    }
     return sum;
 }
 
+
 int main() {
     std::println("AoC 2023: 09");
 
@@ -2,10 +2,11 @@
 #include <vector>
 #include <fstream>
 #include <string_view>
-#include <unordered_map>
 #include <array>
-#include <stack>
-#include <set>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdint>
+#include <bit>
 
 struct Coord {
     int x, y;
@@ -16,110 +17,117 @@ Coord operator+(const Coord& a, const Coord& b) {
     return Coord{a.x + b.x, a.y + b.y};
 }
 
-bool operator<(const Coord& a, const Coord& b) {
-    return a.x < b.x || (a.x == b.x && a.y < b.y);
-}
-
 static std::vector<Coord> neighbors{ {0, -1}, {-1, 0}, {1, 0}, {0, 1} };
-static std::unordered_map<char, std::array<std::string, 4>> mapNeighbors {
-        {'|', { "|F7", "", "", "|LJ" } },
-        {'-', { "", "-LF", "-J7", "" } },
-        {'L', { "|F7", "", "-J7", "" } },
-        {'J', { "|F7", "-LF", "", "" } },
-        {'7', { "", "-LF", "", "|LJ" } },
-        {'F', { "", "", "-J7", "|LJ" } }
-};
+
+// one bit per connection, in the order of neighbors: the opposite of bit i is bit 3 - i
+enum Connection : std::uint8_t { up = 1, left = 2, right = 4, down = 8 };
+
+[[nodiscard]] constexpr std::uint8_t opposite(std::size_t i) { return static_cast<std::uint8_t>(1u << (3 - i)); }
+
+static constexpr auto charToConnections = [] {
+    std::array<std::uint8_t, 256> table{};
+    table['|'] = up | down;
+    table['-'] = left | right;
+    table['L'] = up | right;
+    table['J'] = up | left;
+    table['7'] = left | down;
+    table['F'] = right | down;
+    return table;
+}();
 
 struct Pipes {
-    std::vector<std::string> pipes;
+    std::vector<std::uint8_t> tiles;// connection mask per tile, row-major with stride width
     std::vector<Coord> loop;
+    std::vector<bool> inLoop;// bitmap over the grid, same layout as tiles
+    int width{0}, height{0};
     Coord start{-1, -1};
 
-    [[nodiscard]] char at(const Coord& c) const { return at(c.y, c.x); }
-    [[nodiscard]] char at(int y, int x) const {
-        if (x < 0 || y < 0 || y >= static_cast<int>(pipes.size()) || x >= static_cast<int>(pipes[y].size()))
-            return ' ';
+    [[nodiscard]] std::uint8_t at(const Coord& c) const { return at(c.y, c.x); }
+    [[nodiscard]] std::uint8_t at(int y, int x) const {
+        if (x < 0 || y < 0 || y >= height || x >= width)
+            return 0;
         else
-            return pipes[y][x];
+            return tiles[y * width + x];
     }
 
+    // the start connects to every neighbor that connects back to it
     void initStart() {
-        findStart();
-        auto startSymbol = getSymbolStart();
-        if (startSymbol == '.')
+        if (start.x < 0)
+            throw std::runtime_error("No start found");
+        std::uint8_t connections{0};
+        for (std::size_t i{0}; i < neighbors.size(); ++i)
+            if (at(start + neighbors[i]) & opposite(i))
+                connections |= 1u << i;
+        if (std::popcount(connections) != 2)
             throw std::runtime_error("Invalid start configuration");
-        pipes[start.y][start.x] = startSymbol;
+        tiles[start.y * width + start.x] = connections;
     }
 
+    // follows the two connections of each pipe around the loop, membership is kept in a flat bitmap
     void computeLoop() {
-        std::stack<Coord> currentStack;
-        currentStack.emplace(start);
-        while (!currentStack.empty()) {
-            auto current = currentStack.top();
-            currentStack.pop();
-            loop.emplace_back(current);
-
-            auto validNeighbors = getValidNeighbors(current);
-            if (validNeighbors.empty())
-                break;
+        inLoop.assign(tiles.size(), false);
+        loop.clear();
 
-            for (const auto& neighbor : validNeighbors) {
-                currentStack.emplace(neighbor);
-            }
-        }
-    }
-
-private:
-    void findStart() {
-        for (std::size_t j{0}; j < pipes.size(); ++j) {
-            auto pos = pipes[j].find('S');
-            if (pos != std::string::npos) {
-                start = Coord{static_cast<int>(pos), static_cast<int>(j)};
-                return;
-            }
-        }
+        Coord previous{start}, current{start};
+        do {
+            loop.emplace_back(current);
+            inLoop[current.y * width + current.x] = true;
+
+            auto next = getNextPipe(current, previous);
+            if (next == current)
+                throw std::runtime_error("Loop is broken");
+            previous = current;
+            current = next;
+        } while (current != start);
     }
 
-    [[nodiscard]] char getSymbolStart() const {
-        for (const auto& [key, arr] : mapNeighbors) {
-            int connections{0};
-            for (std::size_t i{0}; i < arr.size(); ++i) {
-                auto neighborPipe = at(start + neighbors[i]);
-                if (arr[i].contains(neighborPipe))
-                    ++connections;
-            }
-            if (connections == 2)
-                return key;
-        }
-        return '.';
+    [[nodiscard]] bool isLoop(int y, int x) const {
+        return x >= 0 && y >= 0 && y < height && x < width && inLoop[y * width + x];
     }
 
-    [[nodiscard]] std::vector<Coord> getValidNeighbors(const Coord& current) const {
-        auto currentChar = at(current);
-        std::vector<Coord> validNeighbors;
+private:
+    // the connected neighbor we did not come from, or current if there is none
+    [[nodiscard]] Coord getNextPipe(const Coord& current, const Coord& previous) const {
+        auto connections = at(current);
         for (std::size_t i{0}; i < neighbors.size(); ++i) {
-            if (std::find(loop.begin(), loop.end(), current + neighbors[i]) != loop.end())
+            if (!(connections & (1u << i)))
                 continue;
-            auto neighborPipe = at(current + neighbors[i]);
-            auto validOptions = mapNeighbors[currentChar][i];
-            if (validOptions.contains(neighborPipe))
-                validNeighbors.emplace_back(current + neighbors[i]);
+            auto neighbor = current + neighbors[i];
+            if (neighbor == previous)
+                continue;
+            if (at(neighbor) & opposite(i))
+                return neighbor;
         }
-        return validNeighbors;
+        return current;
     }
 };
 
+// decodes every tile to its connection mask once, rows are padded to the widest one
 auto parseInput(std::string_view fileName) {
     std::ifstream infile(fileName);
     if (!infile)
         throw std::runtime_error("Could not open file " + std::string(fileName));
 
-    Pipes pipes;
+    std::vector<std::string> lines;
     while (!infile.eof()) {
         std::string line;
         std::getline(infile, line);
         if (line.empty()) continue;
-        pipes.pipes.push_back(std::move(line));
+        lines.push_back(std::move(line));
+    }
+
+    Pipes pipes;
+    pipes.height = static_cast<int>(lines.size());
+    for (const auto& line : lines)
+        pipes.width = std::max(pipes.width, static_cast<int>(line.size()));
+    pipes.tiles.assign(lines.size() * pipes.width, 0);
+    for (int y{0}; y < pipes.height; ++y) {
+        for (int x{0}; x < static_cast<int>(lines[y].size()); ++x) {
+            auto c = static_cast<unsigned char>(lines[y][x]);
+            if (c == 'S' && pipes.start.x < 0)
+                pipes.start = Coord{x, y};
+            pipes.tiles[y * pipes.width + x] = charToConnections[c];
+        }
     }
     pipes.initStart();
     pipes.computeLoop();
@@ -132,36 +140,35 @@ auto solvePart1(const Pipes& pipes) {
     return ((pipes.loop.size() + 1) / 2);
 }
 
-enum class Direction { undefined, fromUp, fromDown };
-
+// shoelace formula over the ordered loop tiles gives the area A, Pick's theorem A = I + L/2 - 1 then the enclosed tiles I
 auto solvePart2(const Pipes& pipes) {
-    std::set<Coord> insidePoints;
-    auto maxX = std::max_element(pipes.loop.begin(), pipes.loop.end(), [](const auto& c1, const auto& c2) { return c1.x < c2.x; })->x;
-    auto maxY = std::max_element(pipes.loop.begin(), pipes.loop.end(), [](const auto& c1, const auto& c2) { return c1.y < c2.y; })->y;
-    for (int y{0}; y <= maxY; ++y) {
+    long twiceArea{0};
+    for (std::size_t i{0}; i < pipes.loop.size(); ++i) {
+        const auto& c1 = pipes.loop[i];
+        const auto& c2 = pipes.loop[(i + 1) % pipes.loop.size()];
+        twiceArea += static_cast<long>(c1.x) * c2.y - static_cast<long>(c2.x) * c1.y;
+    }
+
+    return std::abs(twiceArea) / 2 - static_cast<long>(pipes.loop.size()) / 2 + 1;
+}
+
+// scanline mode for when the enclosed tiles themselves are needed: row-major mask with stride pipes.width
+// crossing a loop tile that connects upwards toggles inside, which also handles L-J and F-7 runs
+auto getEnclosedMask(const Pipes& pipes) {
+    std::vector<bool> enclosed(pipes.inLoop.size(), false);
+    for (int y{0}; y < pipes.height; ++y) {
         bool inside{false};
-        using enum  Direction;
-        Direction currentDir{undefined};
-        for (int x{0}; x <= maxX; ++x) {
-            auto loopEntry = std::find(pipes.loop.begin(), pipes.loop.end(), Coord{x, y});
-            if (loopEntry == pipes.loop.end() && inside)
-                insidePoints.emplace(Coord{x, y});
-            else { // current coord is a loop entry
-                switch (pipes.at(*loopEntry)) {
-                    case '|': inside = !inside; break; // encounter horizontal pipe: inside toggles
-                    case 'L': currentDir = fromUp; break; // note that we came from upstairs
-                    case 'F': currentDir = fromDown; break; // note that we came from downstairs
-                    case 'J': if (currentDir != fromUp) inside = !inside; // if we did not come from upstairs, toggle inside
-                              currentDir = undefined; break;
-                    case '7': if (currentDir != fromDown) inside = !inside; // if we did not come from downstairs, toggle inside
-                              currentDir = undefined; break;
-                    default: break; // do nothing in other cases
-                }
+        for (int x{0}; x < pipes.width; ++x) {
+            if (!pipes.isLoop(y, x)) {
+                if (inside)
+                    enclosed[y * pipes.width + x] = true;
             }
+            else if (pipes.at(y, x) & up)
+                inside = !inside;
         }
     }
 
-    return insidePoints.size();
+    return enclosed;
 }
 
 int main() {